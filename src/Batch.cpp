@@ -0,0 +1,390 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include "Detector.h"
+#include "FrameSource.h"
+#include "Batch.h"
+
+//an image, or a chunk of consecutive frames from a video decoded by the reader
+class Batch_job
+{
+public:
+  string source;
+  bool video = false;
+  int first_frame = 0;
+  vector<Mat> frames;
+  //position in input order, results are written in this order
+  int sequence = 0;
+};
+
+//video frames are handed out this many at a time, each chunk warm-starts the pose from its first frame
+static const int batch_chunk_frames = 30;
+
+//bounded so the reader never gets more than a few jobs ahead of the workers
+class Batch_queue
+{
+public:
+  deque<Batch_job> jobs;
+  size_t capacity;
+  bool done = false;
+  int next_sequence = 0;
+  mutex lock;
+  condition_variable not_empty;
+  condition_variable not_full;
+};
+
+class Batch_output
+{
+public:
+  FILE *file;
+  bool binary;
+  mutex lock;
+
+  //finished jobs waiting on an earlier, slower one; only formatted rows are held
+  map<int, string> pending;
+  int next_sequence = 0;
+  //the reader waits before queueing a job this far past next_sequence, bounding pending
+  int window;
+  condition_variable written;
+
+  atomic<int> frames;
+  atomic<int> detections;
+  atomic<int> failures;
+};
+
+static void pushJob(Batch_queue &queue, Batch_output &output, Batch_job &job)
+{
+  job.sequence = queue.next_sequence++;
+  {
+    unique_lock<mutex> guard(output.lock);
+    output.written.wait(guard, [&] { return job.sequence < output.next_sequence + output.window; });
+  }
+
+  unique_lock<mutex> guard(queue.lock);
+  queue.not_full.wait(guard, [&] { return queue.jobs.size() < queue.capacity; });
+  queue.jobs.push_back(job);
+  queue.not_empty.notify_one();
+}
+
+static bool popJob(Batch_queue &queue, Batch_job &job)
+{
+  unique_lock<mutex> guard(queue.lock);
+  queue.not_empty.wait(guard, [&] { return !queue.jobs.empty() || queue.done; });
+  if (queue.jobs.empty())
+    return false;
+
+  job = move(queue.jobs.front());
+  queue.jobs.pop_front();
+  queue.not_full.notify_one();
+  return true;
+}
+
+static void finishJobs(Batch_queue &queue)
+{
+  lock_guard<mutex> guard(queue.lock);
+  queue.done = true;
+  queue.not_empty.notify_all();
+}
+
+static bool hasExtension(const string &path, const char **extensions, size_t count)
+{
+  size_t dot = path.rfind('.');
+  if (dot == string::npos)
+    return false;
+
+  string ext = path.substr(dot);
+  transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+  for (size_t i = 0; i < count; i++)
+    if (ext == extensions[i])
+      return true;
+  return false;
+}
+
+static bool isImage(const string &path)
+{
+  static const char *extensions[] = {".jpg", ".jpeg", ".png", ".bmp", ".tif", ".tiff", ".ppm", ".pgm"};
+  return hasExtension(path, extensions, sizeof(extensions) / sizeof(extensions[0]));
+}
+
+static bool isVideo(const string &path)
+{
+  static const char *extensions[] = {".avi", ".mp4", ".m4v", ".mov", ".mkv", ".mjpg", ".mjpeg", ".webm",
+                                     ".mpg", ".mpeg", ".wmv", ".flv"};
+  return hasExtension(path, extensions, sizeof(extensions) / sizeof(extensions[0]));
+}
+
+//videos have to be decoded in order, so the reader does it and spreads the frames over the workers
+static void queueVideo(Batch_queue &queue, Batch_output &output, const string &path)
+{
+  CaptureSource video(path);
+  if (!video.isOpened())
+  {
+    fprintf(stderr, "Failed to open video: %s\n", path.c_str());
+    output.failures++;
+    return;
+  }
+
+  Batch_job job;
+  job.source = path;
+  job.video = true;
+  for (int index = 0; ; index++)
+  {
+    //a fresh Mat per frame, the queued ones must not share a buffer with the decoder
+    Mat frame;
+    bool read = video.read(frame);
+    if (read)
+      job.frames.push_back(frame);
+
+    if (job.frames.size() == (size_t) batch_chunk_frames || (!read && !job.frames.empty()))
+    {
+      pushJob(queue, output, job);
+      job.frames.clear();
+      job.first_frame = index + 1;
+    }
+    if (!read)
+      break;
+  }
+}
+
+//inputs named on the command line are tried as a video when they aren't an image, files found in a
+//directory are skipped unless their extension says what they are
+static void queueInput(Batch_queue &queue, Batch_output &output, const string &path, bool named)
+{
+  struct stat info;
+  if (stat(path.c_str(), &info) != 0)
+  {
+    fprintf(stderr, "Batch input not found: %s\n", path.c_str());
+    output.failures++;
+    return;
+  }
+
+  if (S_ISDIR(info.st_mode))
+  {
+    DIR *dir = opendir(path.c_str());
+    if (dir == nullptr)
+    {
+      fprintf(stderr, "Failed to open directory: %s\n", path.c_str());
+      output.failures++;
+      return;
+    }
+
+    //only names are held in memory, frames are read as the queue drains
+    vector<string> entries;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != nullptr)
+      if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0)
+        entries.push_back(path + "/" + entry->d_name);
+    closedir(dir);
+
+    sort(entries.begin(), entries.end());
+    for (size_t i = 0; i < entries.size(); i++)
+      queueInput(queue, output, entries[i], false);
+  }
+  else if (isImage(path))
+  {
+    //only the name is queued, the image is decoded by the worker
+    Batch_job job;
+    job.source = path;
+    pushJob(queue, output, job);
+  }
+  else if (named || isVideo(path))
+    queueVideo(queue, output, path);
+}
+
+static const char batch_magic[4] = {'C', 'V', 'T', 'B'};
+static const uint32_t batch_version = 1;
+
+static void writeHeader(Batch_output &output)
+{
+  if (!output.binary)
+    fprintf(output.file, "source,frame,found,x,y,area,tx,ty,tz,rx,ry,rz,error\n");
+  else
+  {
+    fwrite(batch_magic, sizeof(batch_magic), 1, output.file);
+    fwrite(&batch_version, sizeof(batch_version), 1, output.file);
+  }
+}
+
+template<typename T> static void appendBytes(string &block, const T *data, size_t count)
+{
+  block.append((const char *) data, sizeof(T) * count);
+}
+
+// binary files start with "CVTB" and a uint32 version, then one record per frame, native endian:
+// uint16 source length, source bytes, int32 frame, uint8 found,
+// int32 x, y, area, double tx, ty, tz, rx, ry, rz, error
+static void appendRecord(Batch_output &output, string &block, const string &source, int index, Results &data)
+{
+  if (!output.binary)
+  {
+    //quotes inside a quoted csv field are doubled
+    string quoted = "\"";
+    for (size_t i = 0; i < source.size(); i++)
+      quoted += source[i] == '"' ? string("\"\"") : string(1, source[i]);
+    quoted += "\"";
+
+    char row[256];
+    if (data.Found)
+      snprintf(row, sizeof(row), ",%d,1,%d,%d,%d,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f\n", index,
+               data.X, data.Y, data.Area, data.Translation[0], data.Translation[1], data.Translation[2],
+               data.Rotation[0], data.Rotation[1], data.Rotation[2], data.Error);
+    else
+      snprintf(row, sizeof(row), ",%d,0,,,,,,,,,,\n", index);
+    block += quoted + row;
+    return;
+  }
+
+  uint16_t length = source.size();
+  int32_t frame = index;
+  uint8_t found = data.Found;
+  int32_t ints[3] = {0, 0, 0};
+  double doubles[7] = {0, 0, 0, 0, 0, 0, 0};
+  if (data.Found)
+  {
+    ints[0] = data.X;
+    ints[1] = data.Y;
+    ints[2] = data.Area;
+    for (int i = 0; i < 3; i++)
+    {
+      doubles[i] = data.Translation[i];
+      doubles[i + 3] = data.Rotation[i];
+    }
+    doubles[6] = data.Error;
+  }
+
+  appendBytes(block, &length, 1);
+  appendBytes(block, source.data(), length);
+  appendBytes(block, &frame, 1);
+  appendBytes(block, &found, 1);
+  appendBytes(block, ints, 3);
+  appendBytes(block, doubles, 7);
+}
+
+//writes a finished job's rows, plus any later ones it was holding up, so the output follows input
+//order and two runs over the same corpus can be diffed
+static void writeBlock(Batch_output &output, int sequence, string &block)
+{
+  lock_guard<mutex> guard(output.lock);
+  output.pending[sequence].swap(block);
+
+  map<int, string>::iterator next;
+  while ((next = output.pending.find(output.next_sequence)) != output.pending.end())
+  {
+    fwrite(next->second.data(), 1, next->second.size(), output.file);
+    output.pending.erase(next);
+    output.next_sequence++;
+  }
+  output.written.notify_all();
+}
+
+static void countFrame(Batch_output &output, Results &results)
+{
+  output.frames++;
+  if (results.Found)
+    output.detections++;
+}
+
+static void batchWorker(Batch_queue &queue, Batch_output &output, Settings &settings)
+{
+  //each worker runs its own pipeline at full quality on every frame
+  Settings worker_settings = settings;
+  worker_settings.latency_target = 0;
+  worker_settings.change_threshold = 0;
+  Detector detector(worker_settings);
+
+  Batch_job job;
+  while (popJob(queue, job))
+  {
+    //jobs reach workers in no particular order, so each one starts cold
+    detector.reset();
+    string block;
+
+    if (!job.video)
+    {
+      Mat frame = imread(job.source, CV_LOAD_IMAGE_COLOR);
+      if (frame.data == nullptr)
+      {
+        fprintf(stderr, "Failed to read image: %s\n", job.source.c_str());
+        output.failures++;
+      }
+      else
+      {
+        Results results = detector.process(frame);
+        appendRecord(output, block, job.source, 0, results);
+        countFrame(output, results);
+      }
+    }
+    else
+    {
+      //a chunk's frames are processed in order, warm-starting the pose from one to the next
+      for (size_t i = 0; i < job.frames.size(); i++)
+      {
+        Results results = detector.process(job.frames[i]);
+        appendRecord(output, block, job.source, job.first_frame + (int) i, results);
+        countFrame(output, results);
+      }
+      job.frames.clear();
+    }
+
+    //failed jobs still take their turn so later ones aren't held forever
+    writeBlock(output, job.sequence, block);
+  }
+}
+
+int runBatch(Settings &settings)
+{
+  Batch_output output;
+  output.frames = 0;
+  output.detections = 0;
+  output.failures = 0;
+
+  size_t dot = settings.batch_output.rfind('.');
+  output.binary = dot == string::npos || settings.batch_output.substr(dot) != ".csv";
+  output.file = fopen(settings.batch_output.c_str(), output.binary ? "wb" : "w");
+  if (output.file == nullptr)
+  {
+    fprintf(stderr, "Failed to open batch output: %s\n", settings.batch_output.c_str());
+    return 1;
+  }
+  writeHeader(output);
+
+  int workers = settings.batch_workers;
+  if (workers <= 0)
+    workers = max(1u, thread::hardware_concurrency());
+
+  //the workers already use every core, keep OpenCV from spawning its own threads on top
+  setNumThreads(0);
+
+  Batch_queue queue;
+  queue.capacity = workers * 2;
+  output.window = workers * 4;
+
+  int64 start = getTickCount();
+  vector<thread> pool;
+  for (int i = 0; i < workers; i++)
+    pool.push_back(thread(batchWorker, ref(queue), ref(output), ref(settings)));
+
+  for (size_t i = 0; i < settings.batch_inputs.size(); i++)
+    queueInput(queue, output, settings.batch_inputs[i], true);
+  finishJobs(queue);
+
+  for (size_t i = 0; i < pool.size(); i++)
+    pool[i].join();
+  fclose(output.file);
+
+  double seconds = (getTickCount() - start) / getTickFrequency();
+  int frames = output.frames;
+  printf("Processed %d frames (%d with a target, %d failed) in %.2fs on %d workers: %.1f frames/s\n",
+         frames, (int) output.detections, (int) output.failures, seconds, workers,
+         seconds > 0 ? frames / seconds : 0);
+  return output.failures > 0 ? 1 : 0;
+}
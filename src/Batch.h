@@ -0,0 +1,7 @@
+#ifndef BATCH_H_
+#define BATCH_H_
+
+#include "Settings.h"
+
+int runBatch(Settings &settings);
+#endif
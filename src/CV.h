@@ -3,24 +3,28 @@
 
 #include <vector>
 #include <opencv2/opencv.hpp>
-#include <zmq.hpp>
 #include "Settings.h"
+#include "Pose.h"
+#include "Governor.h"
+#include "Change.h"
 
 using namespace cv;
 using namespace std;
-using namespace zmq;
 
-class Arectangle
-{
-public:
-  int cx, cy, area;
-};
+//hulls smaller than this (pixels) are ignored
+const int HULL_MIN_AREA = 200;
 
 class Image_capsule
 {
 public:
   //image containers
   Mat frame;
+  Mat work;
+
+  //where work sits in frame: work = resize(frame(roi), scale)
+  Rect roi;
+  double scale = 1;
+
   Mat hsv_image;
   Mat threshHold_image;
   Mat contour_image;
@@ -38,18 +42,32 @@ public:
 class contourData
 {
 public:
+  bool Found = false;
+  int Index;
   int Area;
-  int Dist;
   int X;
   int Y;
-  double Angle;
+
+  //governor quality level the result was computed at
+  int Level;
+  //true when the frame was unchanged and this is the previous frame's result
+  bool Reused = false;
+
+  //target pose in camera coordinates, see solveTargetPose
+  Vec3d Translation;
+  Vec3d Rotation;
+  double Error;
 };
 
-void show_help(void);
-void findBoundingBox(Image_capsule &images, vector< vector<Point> > &contours);
+typedef contourData Results;
+
 void getContours(Image_capsule &images, vector< vector<Point> > &contours, vector <Vec4i> &hierarchy);
-void findSquares(Image_capsule &images, vector< vector<Point> > &contours);
-void init(Image_capsule &images, Settings &settings);
-void findConvexHull(Image_capsule &images, vector< vector<Point> > &contours, vector<vector<Point> > &hull,
-		    contourData data);
+void findConvexHull(vector< vector<Point> > &contours, vector<vector<Point> > &hull, contourData &data);
+void prepareFrame(Image_capsule &images, const Quality_level &quality, contourData &last);
+bool thresholdFrame(Image_capsule &images, HSV_capsule &HSVs, Change_capsule &change);
+Point2f workToFrame(Image_capsule &images, Point2f p);
+Point2f frameToWork(Image_capsule &images, Point2f p);
+void findPose(Image_capsule &images, Pose_capsule &pose, vector<Point> &hull, vector<Point2f> &corners,
+              contourData &data, Settings &settings);
+double radian_to_degrees(double radian);
 #endif
@@ -0,0 +1,139 @@
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+#include "Change.h"
+
+//sum of absolute differences between two byte rows, and the largest single difference
+static unsigned rowSAD(const uchar *a, const uchar *b, int n, unsigned &peak)
+{
+  unsigned sum = 0;
+  int i = 0;
+#if defined(__SSE2__)
+  __m128i acc = _mm_setzero_si128();
+  __m128i top = _mm_setzero_si128();
+  for (; i + 16 <= n; i += 16)
+  {
+    __m128i va = _mm_loadu_si128((const __m128i *) (a + i));
+    __m128i vb = _mm_loadu_si128((const __m128i *) (b + i));
+    acc = _mm_add_epi64(acc, _mm_sad_epu8(va, vb));
+    top = _mm_max_epu8(top, _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va)));
+  }
+  sum = _mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+  uchar lanes[16];
+  _mm_storeu_si128((__m128i *) lanes, top);
+#elif defined(__ARM_NEON)
+  uint32x4_t acc = vdupq_n_u32(0);
+  uint8x16_t top = vdupq_n_u8(0);
+  for (; i + 16 <= n; i += 16)
+  {
+    uint8x16_t diff = vabdq_u8(vld1q_u8(a + i), vld1q_u8(b + i));
+    acc = vpadalq_u16(acc, vpaddlq_u8(diff));
+    top = vmaxq_u8(top, diff);
+  }
+  sum = vgetq_lane_u32(acc, 0) + vgetq_lane_u32(acc, 1) + vgetq_lane_u32(acc, 2) + vgetq_lane_u32(acc, 3);
+  uchar lanes[16];
+  vst1q_u8(lanes, top);
+#endif
+#if defined(__SSE2__) || defined(__ARM_NEON)
+  for (int j = 0; j < 16; j++)
+    peak = lanes[j] > peak ? lanes[j] : peak;
+#endif
+  for (; i < n; i++)
+  {
+    unsigned diff = a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+    sum += diff;
+    peak = diff > peak ? diff : peak;
+  }
+  return sum;
+}
+
+int detectChanges(Change_capsule &change, Mat &frame, Settings &settings)
+{
+  if (settings.change_threshold <= 0)
+  {
+    //gating is off, treat the frame as a single changed tile
+    change.tiles_x = 1;
+    change.tiles_y = 1;
+    change.dirty.assign(1, true);
+    change.changed = Rect(0, 0, frame.cols, frame.rows);
+    return 1;
+  }
+
+  resize(frame, change.small, Size(frame.cols / CHANGE_DOWNSAMPLE, frame.rows / CHANGE_DOWNSAMPLE), 0, 0,
+         INTER_AREA);
+
+  change.tiles_x = (change.small.cols + CHANGE_TILE - 1) / CHANGE_TILE;
+  change.tiles_y = (change.small.rows + CHANGE_TILE - 1) / CHANGE_TILE;
+  change.changed = Rect();
+
+  //nothing to compare against, treat the whole frame as changed
+  bool comparable = change.prev_small.size() == change.small.size() &&
+                    change.prev_small.type() == change.small.type();
+  change.dirty.assign(change.tiles_x * change.tiles_y, !comparable);
+  if (!comparable)
+  {
+    change.changed = Rect(0, 0, frame.cols, frame.rows);
+    return change.dirty.size();
+  }
+
+  int channels = change.small.channels();
+  int count = 0;
+  for (int ty = 0; ty < change.tiles_y; ty++)
+    for (int tx = 0; tx < change.tiles_x; tx++)
+    {
+      Rect tile = Rect(tx * CHANGE_TILE, ty * CHANGE_TILE, CHANGE_TILE, CHANGE_TILE) &
+                  Rect(0, 0, change.small.cols, change.small.rows);
+
+      unsigned sad = 0;
+      unsigned peak = 0;
+      for (int y = tile.y; y < tile.y + tile.height; y++)
+        sad += rowSAD(change.small.ptr<uchar>(y) + tile.x * channels,
+                      change.prev_small.ptr<uchar>(y) + tile.x * channels, tile.width * channels, peak);
+
+      //the mean catches lighting drifts across a tile, the peak a small target moving a few pixels,
+      //which barely moves the mean of the 64x64 frame pixels a tile covers
+      if (sad > (unsigned) (settings.change_threshold * tile.area() * channels) ||
+          (settings.change_peak > 0 && peak > (unsigned) settings.change_peak))
+      {
+        change.dirty[ty * change.tiles_x + tx] = true;
+        //the last row and column of tiles also cover the pixels lost to rounding in the downsample
+        int x = tile.x * CHANGE_DOWNSAMPLE;
+        int y = tile.y * CHANGE_DOWNSAMPLE;
+        int right = tx == change.tiles_x - 1 ? frame.cols : (tile.x + tile.width) * CHANGE_DOWNSAMPLE;
+        int bottom = ty == change.tiles_y - 1 ? frame.rows : (tile.y + tile.height) * CHANGE_DOWNSAMPLE;
+        Rect area(x, y, right - x, bottom - y);
+        change.changed = count ? change.changed | area : area;
+        count++;
+      }
+    }
+
+  return count;
+}
+
+void commitChanges(Change_capsule &change, bool whole, Rect roi, double scale, Scalar hsv_min, Scalar hsv_max)
+{
+  if (whole || change.prev_small.size() != change.small.size())
+  {
+    //the frame just compared becomes the new reference, the old buffer is reused next time
+    swap(change.small, change.prev_small);
+  }
+  else
+  {
+    //only the changed tiles were refiltered, the rest must keep being compared to what they were
+    //filtered from, or slow changes (lighting ramps, drifting targets) would never cross the threshold
+    Rect bounds(0, 0, change.small.cols, change.small.rows);
+    for (int ty = 0; ty < change.tiles_y; ty++)
+      for (int tx = 0; tx < change.tiles_x; tx++)
+        if (change.dirty[ty * change.tiles_x + tx])
+        {
+          Rect tile = Rect(tx * CHANGE_TILE, ty * CHANGE_TILE, CHANGE_TILE, CHANGE_TILE) & bounds;
+          change.small(tile).copyTo(change.prev_small(tile));
+        }
+  }
+  change.roi = roi;
+  change.scale = scale;
+  change.hsv_min = hsv_min;
+  change.hsv_max = hsv_max;
+}
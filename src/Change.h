@@ -0,0 +1,37 @@
+#ifndef CHANGE_H_
+#define CHANGE_H_
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "Settings.h"
+
+using namespace cv;
+using namespace std;
+
+//frames are compared at 1/CHANGE_DOWNSAMPLE scale in CHANGE_TILE sized tiles
+const int CHANGE_DOWNSAMPLE = 4;
+const int CHANGE_TILE = 16;
+
+class Change_capsule
+{
+public:
+  //downsampled current frame and the last frame that was fully processed
+  Mat small;
+  Mat prev_small;
+
+  //per tile changed flags and their bounding box in frame coordinates
+  vector<bool> dirty;
+  int tiles_x = 0;
+  int tiles_y = 0;
+  Rect changed;
+
+  //how prev_small was processed, partial reprocessing needs the same again
+  Rect roi;
+  double scale = 0;
+  Scalar hsv_min;
+  Scalar hsv_max;
+};
+
+int detectChanges(Change_capsule &change, Mat &frame, Settings &settings);
+void commitChanges(Change_capsule &change, bool whole, Rect roi, double scale, Scalar hsv_min, Scalar hsv_max);
+#endif
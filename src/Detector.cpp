@@ -0,0 +1,104 @@
+#include <stdio.h>
+#include <math.h>
+#include "Detector.h"
+
+Detector::Detector(Settings &settings) : settings(settings)
+{
+  initPose(pose, settings);
+}
+
+void Detector::reset()
+{
+  pose.has_guess = false;
+  change = Change_capsule();
+  governor = Governor_capsule();
+  last = Results();
+  hull.clear();
+  corners.clear();
+}
+
+void Detector::startFrame()
+{
+  governorFrameStart(governor);
+  frame_started = true;
+}
+
+Results Detector::process(const Mat &frame)
+{
+  if (!frame_started)
+    governorFrameStart(governor);
+  frame_started = false;
+  governorStageEnd(governor, STAGE_CAPTURE);
+
+  //make sure the scalars are updated with the new HSV values
+  HSVs.hsv_min = Scalar(settings.lowH, settings.lowS, settings.lowV);
+  HSVs.hsv_max = Scalar(settings.highH, settings.highS, settings.highV);
+
+  images.frame = frame;
+  Results results;
+  if (detectChanges(change, images.frame, settings) == 0 &&
+      HSVs.hsv_min == change.hsv_min && HSVs.hsv_max == change.hsv_max)
+  {
+    //nothing meaningful changed since the last processed frame, republish its result
+    results = last;
+    results.Reused = true;
+
+    //return before governorFrameEnd: a reused frame costs next to nothing, averaging it in would let
+    //the governor climb to a level the first real change can't afford
+    return results;
+  }
+
+  //crop and downsample to the governor's quality level
+  prepareFrame(images, governorQuality(governor), last);
+
+  //filter to HSV and then the color picker filter
+  bool whole = thresholdFrame(images, HSVs, change);
+  governorStageEnd(governor, STAGE_THRESHOLD);
+  commitChanges(change, whole, images.roi, images.scale, HSVs.hsv_min, HSVs.hsv_max);
+
+  //find contours in the image
+  vector< vector<Point> > contours;
+  vector <Vec4i> hierarchy;
+  getContours(images, contours, hierarchy);
+  governorStageEnd(governor, STAGE_CONTOURS);
+
+  hull.assign(contours.size(), vector<Point>());
+  corners.clear();
+  findConvexHull(contours, hull, results);
+  if (results.Found)
+    findPose(images, pose, hull[results.Index], corners, results, settings);
+  else
+    pose.has_guess = false;
+  governorStageEnd(governor, STAGE_POSE);
+
+  results.Level = governor.level;
+  last = results;
+
+  governorFrameEnd(governor, settings);
+  return results;
+}
+
+void Detector::draw(Mat &frame)
+{
+  Scalar color = Scalar(255, 0, 0);
+  for (size_t i = 0; i < hull.size(); i++)
+  {
+    if (contourArea(hull[i]) <= HULL_MIN_AREA)
+      continue;
+
+    drawContours(frame, hull, i, color, 1, 8, vector<Vec4i>(), 0, Point());
+    Moments M = moments(hull[i]);
+    circle(frame, Point(M.m10 / M.m00, M.m01 / M.m00), 2, color, 4);
+  }
+
+  if (!last.Found)
+    return;
+
+  for (size_t i = 0; i < corners.size(); i++)
+    circle(frame, corners[i], 2, Scalar(0, 255, 255), 2);
+
+  char cmsg[50];
+  snprintf(cmsg, sizeof(cmsg), "%.1fin %.1fdeg", norm(last.Translation),
+           radian_to_degrees(atan2(last.Translation[0], last.Translation[2])));
+  putText(frame,cmsg,Point(last.X,last.Y),FONT_HERSHEY_PLAIN,1.0,CV_RGB(255,255,0),2.0);
+}
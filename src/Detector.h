@@ -0,0 +1,39 @@
+#ifndef DETECTOR_H_
+#define DETECTOR_H_
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "CV.h"
+
+using namespace cv;
+using namespace std;
+
+class Detector
+{
+public:
+  //settings are read every frame, so changes (e.g. from trackbars) apply immediately
+  Detector(Settings &settings);
+
+  //forget everything carried between frames: pose guess, change reference, governor level
+  void reset();
+  //call before capturing so the governor counts capture time, otherwise process() starts the clock
+  void startFrame();
+  Results process(const Mat &frame);
+  //draw the hulls, corners and pose of the last processed frame
+  void draw(Mat &frame);
+
+  //per stage state, public for display and benchmarking single stages
+  Image_capsule images;
+  HSV_capsule HSVs;
+  Pose_capsule pose;
+  Governor_capsule governor;
+  Change_capsule change;
+
+private:
+  Settings &settings;
+  Results last;
+  bool frame_started = false;
+  vector< vector<Point> > hull;
+  vector<Point2f> corners;
+};
+#endif
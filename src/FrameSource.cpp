@@ -0,0 +1,65 @@
+#include <stdio.h>
+#include "FrameSource.h"
+
+CaptureSource::CaptureSource(int index) : capture(index)
+{
+}
+
+CaptureSource::CaptureSource(const string &path)
+{
+  capture.open(path);
+}
+
+bool CaptureSource::isOpened()
+{
+  return capture.isOpened();
+}
+
+bool CaptureSource::read(Mat &frame)
+{
+  //get a fresh image from the camera
+  capture >> frame;
+  return capture.isOpened() && frame.data != nullptr;
+}
+
+void CaptureSource::setFps(double fps)
+{
+  capture.set(CV_CAP_PROP_FPS, fps);
+}
+
+ImageSource::ImageSource(const string &path) : path(path)
+{
+}
+
+bool ImageSource::read(Mat &frame)
+{
+  frame = imread(path, CV_LOAD_IMAGE_COLOR);
+  return frame.data != nullptr;
+}
+
+unique_ptr<FrameSource> openSource(Settings &settings)
+{
+  if (settings.mode == Settings::Mode::STATIC)
+    return unique_ptr<FrameSource>(new ImageSource(settings.static_path));
+
+  unique_ptr<CaptureSource> source;
+  if (settings.mode == Settings::Mode::STREAM)
+  {
+    source.reset(new CaptureSource(settings.stream_path));
+    if (!source->isOpened())
+    {
+      fprintf(stderr, "Failed to open mjpg stream for reading: %s\n", settings.stream_path.c_str());
+      return nullptr;
+    }
+  }
+  else
+  {
+    source.reset(new CaptureSource(settings.cam_index));
+    if (!source->isOpened())
+    {
+      fprintf(stderr, "Error, image source not found.\n");
+      return nullptr;
+    }
+  }
+  return move(source);
+}
@@ -0,0 +1,50 @@
+#ifndef FRAMESOURCE_H_
+#define FRAMESOURCE_H_
+
+#include <string>
+#include <memory>
+#include <opencv2/opencv.hpp>
+#include "Settings.h"
+
+using namespace cv;
+using namespace std;
+
+class FrameSource
+{
+public:
+  virtual ~FrameSource() {}
+
+  //false once the source has no frame to give
+  virtual bool read(Mat &frame) = 0;
+  //a request only, sources that can't change rate ignore it
+  virtual void setFps(double fps) {}
+};
+
+//USB cameras, mjpg streams and video files
+class CaptureSource : public FrameSource
+{
+public:
+  CaptureSource(int index);
+  CaptureSource(const string &path);
+
+  bool isOpened();
+  bool read(Mat &frame);
+  void setFps(double fps);
+
+  VideoCapture capture;
+};
+
+//a still image, reloaded on every read so it can be edited while running
+class ImageSource : public FrameSource
+{
+public:
+  ImageSource(const string &path);
+
+  bool read(Mat &frame);
+
+  string path;
+};
+
+//opens the source selected by settings.mode, printing an error and returning null on failure
+unique_ptr<FrameSource> openSource(Settings &settings);
+#endif
@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include "Governor.h"
+
+//ordered from best quality to cheapest
+static const Quality_level levels[LEVEL_COUNT] =
+{
+  // scale, pyramid, roi, fps
+  {1.0, 0, 1.0, 30},
+  {1.0, 0, 0.6, 30},
+  {0.75, 0, 0.6, 30},
+  {0.75, 1, 0.6, 30},
+  {0.75, 1, 0.4, 20},
+  {0.75, 2, 0.4, 15},
+};
+
+//frames to wait after a step before judging the new level
+static const int settle_down_frames = 5;
+static const int settle_up_frames = 30;
+
+static double ticks_to_ms(int64 ticks)
+{
+  return ticks * 1000.0 / getTickFrequency();
+}
+
+static double smooth(double average, double sample)
+{
+  return average == 0 ? sample : average * 0.8 + sample * 0.2;
+}
+
+//fraction of the frame's pixels the threshold and contour stages work on at a level
+static double pixelShare(const Quality_level &quality)
+{
+  return quality.scale * quality.scale * quality.roi * quality.roi / (1 << (2 * quality.pyramid));
+}
+
+const Quality_level &governorQuality(Governor_capsule &gov)
+{
+  return levels[gov.level];
+}
+
+void governorFrameStart(Governor_capsule &gov)
+{
+  gov.frame_start = getTickCount();
+  gov.stage_start = gov.frame_start;
+  gov.capture_end = gov.frame_start;
+}
+
+void governorStageEnd(Governor_capsule &gov, Stage stage)
+{
+  int64 now = getTickCount();
+  gov.stages[stage] = smooth(gov.stages[stage], ticks_to_ms(now - gov.stage_start));
+  gov.stage_start = now;
+  if (stage == STAGE_CAPTURE)
+    gov.capture_end = now;
+}
+
+double governorElapsed(Governor_capsule &gov)
+{
+  return ticks_to_ms(getTickCount() - gov.frame_start);
+}
+
+void governorFrameEnd(Governor_capsule &gov, Settings &settings)
+{
+  //time blocked waiting on the camera is set by the capture rate, not by how much work we do,
+  //so counting it would keep the lower fps levels over the target forever
+  gov.latency = smooth(gov.latency, ticks_to_ms(getTickCount() - gov.capture_end));
+  gov.changed = false;
+  gov.frames_at_level++;
+  if (settings.latency_target <= 0)
+    return;
+
+  int next = gov.level;
+  if (gov.latency > settings.latency_target)
+  {
+    if (gov.frames_at_level >= settle_down_frames && gov.level < LEVEL_COUNT - 1)
+    {
+      //threshold and contours scale with the pixels processed, pose and overhead don't: when the
+      //pixel stages dominate, go straight to the best level predicted to fit instead of one step at
+      //a time; when pose dominates no level is predicted to fit and we only step once
+      double pixels = gov.stages[STAGE_THRESHOLD] + gov.stages[STAGE_CONTOURS];
+      double fixed = gov.latency > pixels ? gov.latency - pixels : 0;
+      double share = pixelShare(levels[gov.level]);
+      next = gov.level + 1;
+      for (int i = gov.level + 1; i < LEVEL_COUNT; i++)
+        if (fixed + pixels * pixelShare(levels[i]) / share <= settings.latency_target)
+        {
+          next = i;
+          break;
+        }
+    }
+  }
+  else if (gov.frames_at_level >= settle_up_frames && gov.level > 0)
+  {
+    //only step up if the better level held the target last time we ran it,
+    //slowly forgetting so we recover once the coprocessor cools down
+    double &above = gov.level_latency[gov.level - 1];
+    above *= 0.99;
+    if (above < settings.latency_target)
+      next = gov.level - 1;
+  }
+
+  if (next == gov.level)
+    return;
+
+  if (settings.debug)
+    printf("quality level %d -> %d: %.1fms (capture %.1f, threshold %.1f, contours %.1f, pose %.1f)\n",
+           gov.level, next, gov.latency, gov.stages[STAGE_CAPTURE], gov.stages[STAGE_THRESHOLD],
+           gov.stages[STAGE_CONTOURS], gov.stages[STAGE_POSE]);
+
+  gov.level_latency[gov.level] = gov.latency;
+  gov.level = next;
+  gov.frames_at_level = 0;
+  gov.changed = true;
+
+  //the averages describe the old level, start the new one from its own first frame
+  gov.latency = 0;
+  for (int i = 0; i < STAGE_COUNT; i++)
+    gov.stages[i] = 0;
+}
@@ -0,0 +1,50 @@
+#ifndef GOVERNOR_H_
+#define GOVERNOR_H_
+
+#include <opencv2/opencv.hpp>
+#include "Settings.h"
+
+using namespace cv;
+
+struct Quality_level
+{
+  double scale;   //resize factor applied before processing
+  int pyramid;    //pyrDown steps applied after the resize
+  double roi;     //search window side as a fraction of the frame, 1 = whole frame
+  double fps;     //requested capture rate
+};
+
+enum Stage
+{
+  STAGE_CAPTURE,
+  STAGE_THRESHOLD,
+  STAGE_CONTOURS,
+  STAGE_POSE,
+  STAGE_COUNT
+};
+
+const int LEVEL_COUNT = 6;
+
+class Governor_capsule
+{
+public:
+  int level = 0;
+  bool changed = true;
+
+  //smoothed timings in milliseconds, latency runs from the frame arriving to the result
+  double latency = 0;
+  double stages[STAGE_COUNT] = {};
+  double level_latency[LEVEL_COUNT] = {};
+
+  int frames_at_level = 0;
+  int64 frame_start = 0;
+  int64 stage_start = 0;
+  int64 capture_end = 0;
+};
+
+const Quality_level &governorQuality(Governor_capsule &gov);
+void governorFrameStart(Governor_capsule &gov);
+void governorStageEnd(Governor_capsule &gov, Stage stage);
+void governorFrameEnd(Governor_capsule &gov, Settings &settings);
+double governorElapsed(Governor_capsule &gov);
+#endif
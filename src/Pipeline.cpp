@@ -0,0 +1,138 @@
+#include <math.h>
+#include "CV.h"
+
+void getContours(Image_capsule &images, vector< vector<Point> > &contours, vector <Vec4i> &hierarchy)
+{
+  //filter until only contours appear
+  Canny(images.threshHold_image, images.contour_image, 255, 255, 3);
+  morphologyEx(images.contour_image, images.contour_image, MORPH_CLOSE, Mat(), Point(-1, -1),1);
+  findContours(images.contour_image, contours, hierarchy, CV_RETR_TREE, CV_CHAIN_APPROX_SIMPLE, Point(0, 0));
+
+  //everything downstream works in full frame coordinates
+  for (size_t i = 0; i < contours.size(); i++)
+    for (size_t j = 0; j < contours[i].size(); j++)
+      contours[i][j] = workToFrame(images, contours[i][j]);
+}
+
+void prepareFrame(Image_capsule &images, const Quality_level &quality, contourData &last)
+{
+  Rect full(0, 0, images.frame.cols, images.frame.rows);
+  images.roi = full;
+  if (quality.roi < 1 && last.Found)
+  {
+    //search a window around where the target was last frame
+    int w = full.width * quality.roi;
+    int h = full.height * quality.roi;
+    images.roi = Rect(last.X - w / 2, last.Y - h / 2, w, h) & full;
+  }
+
+  images.scale = quality.scale;
+  if (quality.scale != 1)
+    resize(images.frame(images.roi), images.work, Size(), quality.scale, quality.scale, INTER_AREA);
+  else
+    images.work = images.frame(images.roi);
+
+  for (int i = 0; i < quality.pyramid; i++)
+  {
+    Mat down;
+    pyrDown(images.work, down);
+    images.work = down;
+    images.scale /= 2;
+  }
+}
+
+bool thresholdFrame(Image_capsule &images, HSV_capsule &HSVs, Change_capsule &change)
+{
+  //only the changed tiles need refiltering if the reference frame was filtered the same way
+  bool partial = change.roi == images.roi && change.scale == images.scale &&
+                 change.hsv_min == HSVs.hsv_min && change.hsv_max == HSVs.hsv_max &&
+                 images.threshHold_image.size() == images.work.size();
+  if (!partial)
+  {
+    cvtColor(images.work, images.hsv_image, CV_BGR2HSV);
+    inRange(images.hsv_image, HSVs.hsv_min, HSVs.hsv_max, images.threshHold_image);
+    return true;
+  }
+
+  //changes outside the search window don't matter
+  Rect changed = change.changed & images.roi;
+  if (changed.area() == 0)
+    return false;
+
+  //pad a few pixels for the blur from resizing
+  Rect whole(0, 0, images.work.cols, images.work.rows);
+  Point2f tl = frameToWork(images, changed.tl());
+  Point2f br = frameToWork(images, changed.br());
+  Rect dirty = Rect(Point(floor(tl.x) - 4, floor(tl.y) - 4), Point(ceil(br.x) + 4, ceil(br.y) + 4)) & whole;
+  if (dirty.area() == 0)
+    return false;
+
+  Mat hsv = images.hsv_image(dirty);
+  Mat thresh = images.threshHold_image(dirty);
+  cvtColor(images.work(dirty), hsv, CV_BGR2HSV);
+  inRange(hsv, HSVs.hsv_min, HSVs.hsv_max, thresh);
+  return dirty == whole;
+}
+
+Point2f workToFrame(Image_capsule &images, Point2f p)
+{
+  return Point2f(p.x / images.scale + images.roi.x, p.y / images.scale + images.roi.y);
+}
+
+Point2f frameToWork(Image_capsule &images, Point2f p)
+{
+  return Point2f((p.x - images.roi.x) * images.scale, (p.y - images.roi.y) * images.scale);
+}
+
+double radian_to_degrees(double radian)
+{
+  return radian * 180 / M_PI;
+}
+
+void findConvexHull(vector< vector<Point> > &contours, vector<vector<Point> > &hull, contourData &data)
+{
+  for (size_t i = 0; i < contours.size(); i++)
+    convexHull(Mat(contours[i]), hull[i], false);
+  int largestArea = 0;
+  for (size_t i = 0; i < contours.size(); i++)
+  {
+    int area = contourArea(hull[i]);
+    if (area > HULL_MIN_AREA)
+    {
+      Moments M = moments(hull[i]);
+      int u = int(M.m10 / M.m00);
+      int v = int(M.m01 / M.m00);
+
+      if(area > largestArea)
+      {
+	largestArea = area;
+	
+	data.Found = true;
+	data.Index = i;
+	data.X = u;
+	data.Y = v;
+	data.Area = area;
+      }
+    }
+  }
+}
+
+void findPose(Image_capsule &images, Pose_capsule &pose, vector<Point> &hull, vector<Point2f> &corners,
+              contourData &data, Settings &settings)
+{
+  //corners are refined against the threshold image, so find them in its coordinates
+  vector<Point> work_hull(hull.size());
+  for (size_t i = 0; i < hull.size(); i++)
+    work_hull[i] = frameToWork(images, hull[i]);
+
+  bool found = findTargetCorners(pose, images.threshHold_image, work_hull, corners);
+  for (size_t i = 0; i < corners.size(); i++)
+    corners[i] = workToFrame(images, corners[i]);
+
+  if (!found ||
+      !solveTargetPose(pose, corners, data.Translation, data.Rotation, data.Error, settings))
+  {
+    pose.has_guess = false;
+    data.Found = false;
+  }
+}
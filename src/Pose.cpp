@@ -0,0 +1,109 @@
+#include <math.h>
+#include <algorithm>
+#include "Pose.h"
+
+void initPose(Pose_capsule &pose, Settings &settings)
+{
+  pose.camera_matrix = (Mat_<double>(3, 3) <<
+                        settings.focal_x, 0, settings.center_x,
+                        0, settings.focal_y, settings.center_y,
+                        0, 0, 1);
+  pose.dist_coeffs = Mat::zeros(4, 1, CV_64F);
+
+  //target frame: origin at the target center, x right, y down, z into the target
+  double w = settings.target_width / 2;
+  double h = settings.target_height / 2;
+  pose.target_points.clear();
+  pose.target_points.push_back(Point3f(-w, -h, 0));
+  pose.target_points.push_back(Point3f(w, -h, 0));
+  pose.target_points.push_back(Point3f(w, h, 0));
+  pose.target_points.push_back(Point3f(-w, h, 0));
+
+  pose.has_guess = false;
+}
+
+// puts the corners in the same order as target_points:
+// top left, top right, bottom right, bottom left
+static void orderCorners(vector<Point2f> &corners, bool wide)
+{
+  //sorting by angle around the centroid (y points down, so the angle runs clockwise from the left)
+  //never picks a corner twice, even when the target is rolled 45 degrees
+  Point2f center(0, 0);
+  for (size_t i = 0; i < corners.size(); i++)
+    center += corners[i];
+  center *= 1.0 / corners.size();
+
+  std::sort(corners.begin(), corners.end(), [&](const Point2f &a, const Point2f &b)
+  {
+    return atan2(a.y - center.y, a.x - center.x) < atan2(b.y - center.y, b.x - center.x);
+  });
+
+  //that fixes the order but not which corner comes first: the top edge is one of the pair of longer
+  //edges on a wide target (shorter on a tall one), whichever of the two sits higher in the image
+  double even = norm(corners[1] - corners[0]) + norm(corners[3] - corners[2]);
+  double odd = norm(corners[2] - corners[1]) + norm(corners[0] - corners[3]);
+  int first = (even > odd) == wide ? 0 : 1;
+  if (corners[first + 2].y + corners[(first + 3) % 4].y < corners[first].y + corners[first + 1].y)
+    first += 2;
+  std::rotate(corners.begin(), corners.begin() + first, corners.end());
+}
+
+bool findTargetCorners(Pose_capsule &pose, Mat &thresh, vector<Point> &hull, vector<Point2f> &corners)
+{
+  corners.clear();
+  if (hull.size() < 4)
+    return false;
+
+  vector<Point> approx;
+  approxPolyDP(hull, approx, arcLength(hull, true) * 0.02, true);
+  if (approx.size() == 4)
+  {
+    for (size_t i = 0; i < approx.size(); i++)
+      corners.push_back(Point2f(approx[i].x, approx[i].y));
+  }
+  else
+  {
+    //fall back to the tightest rotated rectangle around the hull
+    Point2f rect_points[4];
+    minAreaRect(hull).points(rect_points);
+    corners.assign(rect_points, rect_points + 4);
+  }
+  Point3f size = pose.target_points[2] - pose.target_points[0];
+  orderCorners(corners, size.x >= size.y);
+
+  //refine against the threshold image
+  cornerSubPix(thresh, corners, Size(5, 5), Size(-1, -1),
+               TermCriteria(CV_TERMCRIT_EPS + CV_TERMCRIT_ITER, 20, 0.01));
+  return true;
+}
+
+bool solveTargetPose(Pose_capsule &pose, vector<Point2f> &corners, Vec3d &translation, Vec3d &rotation,
+                     double &error, Settings &settings)
+{
+  if (corners.size() != pose.target_points.size())
+  {
+    pose.has_guess = false;
+    return false;
+  }
+
+  //iterate from the last frame's pose when we have one, it is usually only a few pixels off
+  solvePnP(pose.target_points, corners, pose.camera_matrix, pose.dist_coeffs, pose.rvec, pose.tvec,
+           pose.has_guess, CV_ITERATIVE);
+
+  vector<Point2f> projected;
+  projectPoints(pose.target_points, pose.rvec, pose.tvec, pose.camera_matrix, pose.dist_coeffs, projected);
+  double sum = 0;
+  for (size_t i = 0; i < corners.size(); i++)
+  {
+    Point2f d = projected[i] - corners[i];
+    sum += d.dot(d);
+  }
+  error = sqrt(sum / corners.size());
+
+  translation = Vec3d(pose.tvec.at<double>(0), pose.tvec.at<double>(1), pose.tvec.at<double>(2));
+  rotation = Vec3d(pose.rvec.at<double>(0), pose.rvec.at<double>(1), pose.rvec.at<double>(2));
+
+  //a bad solve would poison the next frame's guess, so start over instead
+  pose.has_guess = error <= settings.max_reproj_error && translation[2] > 0;
+  return pose.has_guess;
+}
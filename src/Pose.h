@@ -0,0 +1,29 @@
+#ifndef POSE_H_
+#define POSE_H_
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "Settings.h"
+
+using namespace cv;
+using namespace std;
+
+class Pose_capsule
+{
+public:
+  //camera and target models, filled once by initPose
+  Mat camera_matrix;
+  Mat dist_coeffs;
+  vector<Point3f> target_points;
+
+  //previous solution, used to warm-start the next solve
+  Mat rvec;
+  Mat tvec;
+  bool has_guess = false;
+};
+
+void initPose(Pose_capsule &pose, Settings &settings);
+bool findTargetCorners(Pose_capsule &pose, Mat &thresh, vector<Point> &hull, vector<Point2f> &corners);
+bool solveTargetPose(Pose_capsule &pose, vector<Point2f> &corners, Vec3d &translation, Vec3d &rotation,
+                     double &error, Settings &settings);
+#endif
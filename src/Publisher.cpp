@@ -0,0 +1,23 @@
+#include <stdio.h>
+#include "zhelpers.hpp"
+#include "Publisher.h"
+
+ZmqPublisher::ZmqPublisher(const string &endpoint) : context(1), socket(context, ZMQ_PUB)
+{
+  socket.bind(endpoint.c_str());
+}
+
+void ZmqPublisher::publish(const Results &results)
+{
+  if (!results.Found)
+    return;
+
+  //translation (inches), rotation (rodrigues vector), reprojection error (pixels), quality level,
+  //1 if the frame was unchanged and this repeats the last processed frame's result
+  char cmsg[128];
+  snprintf(cmsg, sizeof(cmsg), "%.4f %.4f %.4f %.4f %.4f %.4f %.4f %d %d",
+           results.Translation[0], results.Translation[1], results.Translation[2],
+           results.Rotation[0], results.Rotation[1], results.Rotation[2],
+           results.Error, results.Level, results.Reused ? 1 : 0);
+  s_send(socket, string(cmsg));
+}
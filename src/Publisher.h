@@ -0,0 +1,31 @@
+#ifndef PUBLISHER_H_
+#define PUBLISHER_H_
+
+#include <string>
+#include <zmq.hpp>
+#include "CV.h"
+
+using namespace std;
+using namespace zmq;
+
+class Publisher
+{
+public:
+  virtual ~Publisher() {}
+
+  virtual void publish(const Results &results) = 0;
+};
+
+//sends found targets as a space separated string on a ZMQ PUB socket
+class ZmqPublisher : public Publisher
+{
+public:
+  ZmqPublisher(const string &endpoint);
+
+  void publish(const Results &results);
+
+private:
+  context_t context;
+  socket_t socket;
+};
+#endif
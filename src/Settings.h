@@ -2,6 +2,7 @@
 #define SETTINGS_H_
 
 #include <string>
+#include <vector>
 #include <fstream>
 
 using namespace std;
@@ -15,7 +16,8 @@ struct Settings
   enum Mode {
     USB,
     STREAM,
-    STATIC
+    STATIC,
+    BATCH
   };
   Mode mode;
 
@@ -23,6 +25,11 @@ struct Settings
   string static_path = "static_image.jpg";
   string stream_path = "http://axis-camera.local/mjpg/video.mjpg";
 
+  //batch mode: images, videos or directories of them, results go to batch_output
+  vector<string> batch_inputs;
+  string batch_output;
+  int batch_workers = 0;
+
   int lowH = 53;
   int highH = 255;
 
@@ -31,6 +38,28 @@ struct Settings
 
   int lowV = 150;
   int highV = 255;
+
+  //camera intrinsics, in pixels
+  double focal_x = 476.7;
+  double focal_y = 476.7;
+  double center_x = 400;
+  double center_y = 300;
+
+  //physical size of the target's outer corners, in inches
+  double target_width = 20;
+  double target_height = 14;
+
+  //latency from a frame arriving to its result the governor tries to hold, in milliseconds,
+  //0 keeps full quality
+  double latency_target = 40;
+
+  //mean per-pixel difference for a tile to count as changed, 0 disables change gating
+  int change_threshold = 3;
+  //a single (downsampled) pixel differing by more than this also marks its tile, 0 disables
+  int change_peak = 24;
+
+  //pose solutions with a larger RMS reprojection error (pixels) are dropped
+  double max_reproj_error = 4;
 };
 
 #endif
@@ -0,0 +1,385 @@
+#include <stdio.h>
+#include <math.h>
+#include "Detector.h"
+
+//regression tests: most frames are drawn by projecting the target through the same camera model
+//the detector solves with, so the expected pose is known exactly; the golden frames in test/golden
+//add noise, blur, clutter and the hollow target shape, with expected rows in the -b csv format
+
+//make test runs from the repository root
+static const char *golden_dir = "test/golden";
+
+static const char *current_test;
+static int failures = 0;
+
+#define CHECK(cond)                                                                    \
+  do                                                                                   \
+  {                                                                                    \
+    if (!(cond))                                                                       \
+    {                                                                                  \
+      fprintf(stderr, "%s:%d: %s: check failed: %s\n", __FILE__, __LINE__, current_test, #cond); \
+      failures++;                                                                      \
+    }                                                                                  \
+  } while (0)
+
+#define CHECK_NEAR(a, b, tolerance) CHECK(fabs((a) - (b)) <= (tolerance))
+
+static Settings testSettings()
+{
+  Settings settings;
+  settings.mode = Settings::Mode::STATIC;
+  //full quality on every frame, so results don't depend on timing
+  settings.latency_target = 0;
+  return settings;
+}
+
+//draws the target in pure green (inside the default HSV window) on a black 800x600 frame
+static Mat renderTarget(Settings &settings, Vec3d rotation, Vec3d translation, vector<Point2f> &projected)
+{
+  Pose_capsule pose;
+  initPose(pose, settings);
+  projectPoints(pose.target_points, Mat(rotation), Mat(translation), pose.camera_matrix, pose.dist_coeffs, projected);
+
+  //sub-pixel vertices so the drawn edges sit where the projection puts them
+  const int shift = 4;
+  vector<Point> points;
+  for (size_t i = 0; i < projected.size(); i++)
+    points.push_back(Point(cvRound(projected[i].x * (1 << shift)), cvRound(projected[i].y * (1 << shift))));
+
+  Mat frame = Mat::zeros(600, 800, CV_8UC3);
+  fillConvexPoly(frame, &points[0], points.size(), Scalar(0, 255, 0), 8, shift);
+  return frame;
+}
+
+static void checkPose(Settings &settings, Vec3d rotation, Vec3d translation)
+{
+  vector<Point2f> projected;
+  Mat frame = renderTarget(settings, rotation, translation, projected);
+
+  Detector detector(settings);
+  Results results = detector.process(frame);
+
+  CHECK(results.Found);
+  if (!results.Found)
+    return;
+
+  Moments M = moments(projected);
+  CHECK_NEAR(results.X, M.m10 / M.m00, 2);
+  CHECK_NEAR(results.Y, M.m01 / M.m00, 2);
+  CHECK_NEAR(results.Area, contourArea(projected), contourArea(projected) * 0.06);
+
+  CHECK_NEAR(results.Translation[0], translation[0], 1.5);
+  CHECK_NEAR(results.Translation[1], translation[1], 1.5);
+  CHECK_NEAR(results.Translation[2], translation[2], 3);
+  for (int i = 0; i < 3; i++)
+    CHECK_NEAR(results.Rotation[i], rotation[i], 0.15);
+  CHECK(results.Error <= settings.max_reproj_error);
+}
+
+static void testFrontal()
+{
+  Settings settings = testSettings();
+  checkPose(settings, Vec3d(0, 0, 0), Vec3d(0, 0, 60));
+}
+
+static void testYawed()
+{
+  Settings settings = testSettings();
+  checkPose(settings, Vec3d(0, 0.35, 0), Vec3d(8, -4, 72));
+}
+
+static void testRolled()
+{
+  //a 45 degree roll is where picking corners by x+y and x-y used to tie
+  Settings settings = testSettings();
+  checkPose(settings, Vec3d(0, 0, CV_PI / 4), Vec3d(0, 0, 60));
+}
+
+static void testEmptyFrame()
+{
+  Settings settings = testSettings();
+  Detector detector(settings);
+  Results results = detector.process(Mat::zeros(600, 800, CV_8UC3));
+  CHECK(!results.Found);
+}
+
+static void testTargetAtEdge()
+{
+  //the target's left edge lands on the first column of the frame, it is still whole and must be found
+  Settings settings = testSettings();
+  vector<Point2f> projected;
+  Mat frame = renderTarget(settings, Vec3d(0, 0, 0), Vec3d(-40.28, 0, 60), projected);
+
+  Detector detector(settings);
+  Results results = detector.process(frame);
+  CHECK(results.Found);
+  if (!results.Found)
+    return;
+
+  Moments M = moments(projected);
+  CHECK_NEAR(results.X, M.m10 / M.m00, 2);
+  CHECK_NEAR(results.Y, M.m01 / M.m00, 2);
+  CHECK(results.Error <= settings.max_reproj_error);
+}
+
+static void checkSame(Results &a, Results &b)
+{
+  CHECK(a.Found == b.Found);
+  CHECK(a.X == b.X);
+  CHECK(a.Y == b.Y);
+  CHECK(a.Area == b.Area);
+  for (int i = 0; i < 3; i++)
+  {
+    CHECK_NEAR(a.Translation[i], b.Translation[i], 1e-9);
+    CHECK_NEAR(a.Rotation[i], b.Rotation[i], 1e-9);
+  }
+}
+
+static void testReset()
+{
+  Settings settings = testSettings();
+  vector<Point2f> projected;
+  Mat first = renderTarget(settings, Vec3d(0, 0.35, 0), Vec3d(8, -4, 72), projected);
+  Mat second = renderTarget(settings, Vec3d(0, 0, 0), Vec3d(0, 0, 60), projected);
+
+  Detector fresh(settings);
+  Results expected = fresh.process(second);
+
+  //after a reset nothing from earlier frames (pose guess, change reference) may leak in
+  Detector used(settings);
+  used.process(first);
+  used.process(second);
+  used.reset();
+  Results results = used.process(second);
+  CHECK(!results.Reused);
+  checkSame(results, expected);
+}
+
+static void testUnchangedFrameReused()
+{
+  Settings settings = testSettings();
+  vector<Point2f> projected;
+  Mat frame = renderTarget(settings, Vec3d(0, 0, 0), Vec3d(0, 0, 60), projected);
+
+  Detector detector(settings);
+  Results first = detector.process(frame);
+  Results second = detector.process(frame.clone());
+  CHECK(!first.Reused);
+  CHECK(second.Reused);
+  checkSame(first, second);
+}
+
+static void testThresholdStage()
+{
+  //single stages run on their own, without a Detector
+  Settings settings = testSettings();
+  vector<Point2f> projected;
+  Mat frame = renderTarget(settings, Vec3d(0, 0, 0), Vec3d(0, 0, 60), projected);
+
+  Image_capsule images;
+  images.frame = frame;
+  images.work = frame;
+  images.roi = Rect(0, 0, frame.cols, frame.rows);
+  images.scale = 1;
+  HSV_capsule HSVs;
+  HSVs.hsv_min = Scalar(settings.lowH, settings.lowS, settings.lowV);
+  HSVs.hsv_max = Scalar(settings.highH, settings.highS, settings.highV);
+  Change_capsule change;
+
+  CHECK(thresholdFrame(images, HSVs, change));
+  double area = contourArea(projected);
+  CHECK_NEAR(countNonZero(images.threshHold_image), area, area * 0.03);
+}
+
+static int countDirty(Change_capsule &change)
+{
+  int dirty = 0;
+  for (size_t i = 0; i < change.dirty.size(); i++)
+    dirty += change.dirty[i];
+  return dirty;
+}
+
+static void checkSameThreshold(Detector &partial, Detector &full)
+{
+  Mat diff;
+  compare(partial.images.threshHold_image, full.images.threshHold_image, diff, CMP_NE);
+  CHECK(countNonZero(diff) == 0);
+}
+
+static void testOneTileChanged()
+{
+  //a distractor appears inside the tile covering frame pixels (64..127, 64..127)
+  Settings settings = testSettings();
+  vector<Point2f> projected;
+  Mat first = renderTarget(settings, Vec3d(0, 0, 0), Vec3d(0, 0, 60), projected);
+  Mat second = first.clone();
+  rectangle(second, Point(70, 70), Point(120, 110), Scalar(0, 255, 0), CV_FILLED);
+
+  Detector partial(settings);
+  partial.process(first);
+  Results results = partial.process(second);
+  CHECK(!results.Reused);
+  CHECK(countDirty(partial.change) == 1);
+
+  //only that tile was refiltered, the outcome must match processing the frame from scratch
+  Detector full(settings);
+  Results expected = full.process(second);
+  checkSameThreshold(partial, full);
+  CHECK(results.Found == expected.Found);
+  CHECK(results.X == expected.X);
+  CHECK(results.Y == expected.Y);
+  CHECK(results.Area == expected.Area);
+  for (int i = 0; i < 3; i++)
+  {
+    CHECK_NEAR(results.Translation[i], expected.Translation[i], 0.01);
+    CHECK_NEAR(results.Rotation[i], expected.Rotation[i], 0.001);
+  }
+}
+
+static void testSlowDrift()
+{
+  //one tile brightens by a step too small to notice on its own, while another flickers so every
+  //frame takes the partial refilter path; the drifting tile must still be refiltered once the
+  //drift since it was last filtered adds up
+  Settings settings = testSettings();
+  Rect drift(256, 448, 64, 64);
+  Rect flicker(576, 64, 64, 64);
+  Detector partial(settings);
+  bool drift_seen = false;
+  Mat frame;
+  for (int value = 130; value <= 170; value++)
+  {
+    frame = Mat::zeros(600, 800, CV_8UC3);
+    frame(drift).setTo(Scalar(0, value, 0));
+    if (value % 2)
+      frame(flicker).setTo(Scalar(255, 255, 255));
+
+    Results results = partial.process(frame);
+    CHECK(!results.Reused);
+    int tile = (drift.y / (CHANGE_DOWNSAMPLE * CHANGE_TILE)) * partial.change.tiles_x +
+               drift.x / (CHANGE_DOWNSAMPLE * CHANGE_TILE);
+    if (value > 130 && partial.change.dirty[tile])
+      drift_seen = true;
+  }
+  CHECK(drift_seen);
+
+  //the drift crossed the value threshold (150) on the way, the mask must show it
+  CHECK(countNonZero(partial.images.threshHold_image(drift)) == drift.area());
+  Detector full(settings);
+  full.process(frame);
+  checkSameThreshold(partial, full);
+}
+
+static void testChangeOutsideWindow()
+{
+  //a change entirely outside the search window leaves nothing to refilter
+  Settings settings = testSettings();
+  Mat frame = Mat::zeros(600, 800, CV_8UC3);
+
+  Image_capsule images;
+  images.frame = frame;
+  images.roi = Rect(200, 150, 400, 300);
+  images.work = frame(images.roi);
+  images.scale = 1;
+  images.threshHold_image = Mat::zeros(images.work.size(), CV_8U);
+  images.hsv_image = Mat::zeros(images.work.size(), CV_8UC3);
+  HSV_capsule HSVs;
+  HSVs.hsv_min = Scalar(settings.lowH, settings.lowS, settings.lowV);
+  HSVs.hsv_max = Scalar(settings.highH, settings.highS, settings.highV);
+  Change_capsule change;
+  change.roi = images.roi;
+  change.scale = images.scale;
+  change.hsv_min = HSVs.hsv_min;
+  change.hsv_max = HSVs.hsv_max;
+  change.changed = Rect(0, 0, 64, 64);
+
+  CHECK(!thresholdFrame(images, HSVs, change));
+}
+
+static void testGoldenFrames()
+{
+  string path = string(golden_dir) + "/expected.csv";
+  FILE *expected = fopen(path.c_str(), "r");
+  CHECK(expected != nullptr);
+  if (expected == nullptr)
+    return;
+
+  const char *test_name = current_test;
+  int rows = 0;
+  char line[512];
+  while (fgets(line, sizeof(line), expected) != nullptr)
+  {
+    char source[256];
+    int frame_index, found, x, y, area;
+    double t[3], r[3], error;
+    int fields = sscanf(line, "\"%255[^\"]\",%d,%d,%d,%d,%d,%lf,%lf,%lf,%lf,%lf,%lf,%lf", source, &frame_index,
+                        &found, &x, &y, &area, &t[0], &t[1], &t[2], &r[0], &r[1], &r[2], &error);
+    //the header and blank lines don't parse
+    if (fields < 3)
+      continue;
+    rows++;
+
+    //failures name the frame rather than the test
+    current_test = source;
+    Mat frame = imread(string(golden_dir) + "/" + source, CV_LOAD_IMAGE_COLOR);
+    CHECK(frame.data != nullptr);
+    if (frame.data == nullptr)
+      continue;
+
+    Settings settings = testSettings();
+    Detector detector(settings);
+    Results results = detector.process(frame);
+    CHECK(results.Found == (found != 0));
+    if (!results.Found || !found || fields != 13)
+      continue;
+
+    CHECK_NEAR(results.X, x, 3);
+    CHECK_NEAR(results.Y, y, 3);
+    CHECK_NEAR(results.Area, area, area * 0.05);
+    CHECK_NEAR(results.Translation[0], t[0], 1);
+    CHECK_NEAR(results.Translation[1], t[1], 1);
+    CHECK_NEAR(results.Translation[2], t[2], t[2] * 0.03);
+    for (int i = 0; i < 3; i++)
+      CHECK_NEAR(results.Rotation[i], r[i], 0.1);
+    //the expected error is the true pose's, 0 for rendered frames
+    CHECK(results.Error <= error + settings.max_reproj_error);
+  }
+  fclose(expected);
+  current_test = test_name;
+  CHECK(rows > 0);
+}
+
+int main(void)
+{
+  struct
+  {
+    const char *name;
+    void (*run)(void);
+  } tests[] =
+  {
+    {"frontal", testFrontal},
+    {"yawed", testYawed},
+    {"rolled", testRolled},
+    {"empty frame", testEmptyFrame},
+    {"target at edge", testTargetAtEdge},
+    {"reset", testReset},
+    {"unchanged frame reused", testUnchangedFrameReused},
+    {"threshold stage", testThresholdStage},
+    {"one tile changed", testOneTileChanged},
+    {"slow drift", testSlowDrift},
+    {"change outside window", testChangeOutsideWindow},
+    {"golden frames", testGoldenFrames},
+  };
+
+  int count = sizeof(tests) / sizeof(tests[0]);
+  for (int i = 0; i < count; i++)
+  {
+    current_test = tests[i].name;
+    int before = failures;
+    tests[i].run();
+    printf("%s %s\n", failures == before ? "PASS" : "FAIL", tests[i].name);
+  }
+
+  printf("%d checks failed\n", failures);
+  return failures > 0 ? 1 : 0;
+}
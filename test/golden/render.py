@@ -0,0 +1,103 @@
+#!/usr/bin/env python3
+# Regenerates the golden frames and expected.csv in this directory.
+#
+# Each frame is the 20x14in hollow (U shaped, 2in tape) target rendered through the default camera
+# model onto a cluttered background (grey boxes, a dim green blob, bright warm lights), then blurred,
+# given sensor noise and saved as JPEG. expected.csv holds the true pose in the -b output format;
+# the error column is the true reprojection error, 0. Recorded frames can be added next to these
+# with a hand-checked row each.
+#
+# Needs numpy and the opencv python bindings. The seed is fixed, so reruns give the same frames.
+import os
+import sys
+
+import cv2
+import numpy as np
+
+CAMERA = np.array([[476.7, 0, 400], [0, 476.7, 300], [0, 0, 1]])
+WIDTH, HEIGHT, TAPE = 20.0, 14.0, 2.0
+GREEN = np.array([90, 255, 60], np.float32)
+
+# name, rotation (rodrigues), translation (inches), degradations
+CASES = [
+    ("frontal.jpg", (0, 0, 0), (0, 0, 60), {}),
+    ("yawed.jpg", (0, 0.35, 0), (8, -4, 72), {}),
+    ("rolled.jpg", (0, 0, 0.3), (-6, 3, 80), {}),
+    ("pitched.jpg", (-0.3, 0, 0), (0, 6, 70), {}),
+    ("far_motion_blur.jpg", (0, -0.2, 0), (5, -2, 110), {"motion": 5, "blur": 1.2}),
+    ("no_target.jpg", None, None, {}),
+]
+
+
+def outline():
+    w, h = WIDTH / 2, HEIGHT / 2
+    return np.array([[-w, -h, 0], [w, -h, 0], [w, h, 0], [-w, h, 0]], np.float64)
+
+
+def tape():
+    w, h, t = WIDTH / 2, HEIGHT / 2, TAPE
+    return np.array([[-w, -h, 0], [-w + t, -h, 0], [-w + t, h - t, 0], [w - t, h - t, 0],
+                     [w - t, -h, 0], [w, -h, 0], [w, h, 0], [-w, h, 0]], np.float64)
+
+
+def project(points, rotation, translation):
+    projected, _ = cv2.projectPoints(points, np.array(rotation, float), np.array(translation, float),
+                                     CAMERA, np.zeros(4))
+    return projected.reshape(-1, 2)
+
+
+def background(rng):
+    image = np.zeros((600, 800, 3), np.float32)
+    image[:] = np.linspace(25, 60, 600)[:, None, None]
+    for _ in range(8):
+        x, y = rng.integers(0, 760), rng.integers(0, 560)
+        w, h = rng.integers(30, 160), rng.integers(20, 120)
+        grey = float(rng.integers(40, 110))
+        cv2.rectangle(image, (int(x), int(y)), (int(x + w), int(y + h)), (grey, grey, grey), -1)
+    # below the default value threshold, and outside the default hue window
+    cv2.circle(image, (650, 120), 35, (40, 110, 50), -1)
+    cv2.rectangle(image, (60, 480), (220, 520), (40, 150, 255), -1)
+    cv2.circle(image, (720, 450), 20, (120, 220, 250), -1)
+    return image
+
+
+def render(rng, rotation, translation, blur=1.0, motion=0, noise=6):
+    image = background(rng)
+    if rotation is not None:
+        # 8x supersampled coverage gives anti-aliased edges
+        ss = 8
+        big = np.zeros((600 * ss, 800 * ss), np.uint8)
+        polygon = np.round(project(tape(), rotation, translation) * ss * 16).astype(np.int32)
+        cv2.fillPoly(big, [polygon], 255, cv2.LINE_8, 4)
+        coverage = cv2.resize(big, (800, 600), interpolation=cv2.INTER_AREA).astype(np.float32) / 255
+        image = image * (1 - coverage[..., None]) + GREEN * coverage[..., None]
+    if motion:
+        kernel = np.zeros((motion, motion), np.float32)
+        kernel[motion // 2, :] = 1.0 / motion
+        image = cv2.filter2D(image, -1, kernel)
+    image = cv2.GaussianBlur(image, (0, 0), blur)
+    image += rng.normal(0, noise, image.shape).astype(np.float32)
+    return np.clip(image, 0, 255).astype(np.uint8)
+
+
+def main(out):
+    rng = np.random.default_rng(4795)
+    rows = ["source,frame,found,x,y,area,tx,ty,tz,rx,ry,rz,error"]
+    for name, rotation, translation, degrade in CASES:
+        image = render(rng, rotation, translation, **degrade)
+        cv2.imwrite(os.path.join(out, name), image, [cv2.IMWRITE_JPEG_QUALITY, 92])
+        if rotation is None:
+            rows.append('"%s",0,0,,,,,,,,,,' % name)
+            continue
+
+        corners = project(outline(), rotation, translation).astype(np.float32)
+        m = cv2.moments(corners)
+        rows.append('"%s",0,1,%d,%d,%d,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f' %
+                    ((name, int(m["m10"] / m["m00"]), int(m["m01"] / m["m00"]), int(cv2.contourArea(corners)))
+                     + tuple(translation) + tuple(rotation) + (0,)))
+    with open(os.path.join(out, "expected.csv"), "w") as f:
+        f.write("\n".join(rows) + "\n")
+
+
+if __name__ == "__main__":
+    main(sys.argv[1] if len(sys.argv) > 1 else os.path.dirname(os.path.abspath(__file__)))